@@ -0,0 +1,59 @@
+#ifndef GRID_H_
+#define GRID_H_ GRID_H_
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+
+template <int N>
+class Grid {
+protected:
+    std::array<int, N> shape;
+    std::array<double, N> size;
+    std::array<int, N> offset;
+    int elements;
+
+public:
+    Grid(
+                std::array<int, N> const & shape, 
+                std::array<double, N> const & size) 
+            : shape(shape), size(size) {
+        if (N <= 0) {
+            throw std::invalid_argument(
+                "Dimensionality of space must be positive.");
+        }
+
+        if (*std::min_element(this->shape.begin(), this->shape.end()) < 1 
+                || *std::min_element(
+                        this->size.begin(), this->size.end()) <= 0.0) {
+            throw std::invalid_argument(
+                "Input arguments \"shape\" and \"size\" must be positive.");
+        }
+
+        this->elements = 1;
+        for (int i = N - 1; i >= 0; --i) {
+            this->offset[i] = this->elements;
+            this->elements *= this->shape[i];
+        }
+    }
+
+    int linear_index(std::array<int, N> const & index) const {
+        int linear_index = 0;
+        for (int i = 0; i < N; ++i) {
+            linear_index += index[i] * this->offset[i];
+        }
+        return linear_index;
+    }
+
+    std::array<int, N> get_shape() const {
+        return this->shape;
+    }
+
+    std::array<double, N> get_size() const {
+        return this->size;
+    }
+};
+
+
+#endif
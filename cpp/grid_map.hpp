@@ -1,6 +1,7 @@
 #ifndef GRID_MAP_H_
 #define GRID_MAP_H_ GRID_MAP_H_
 
+#include "grid.hpp"
 #include <algorithm>
 #include <array>
 #include <exception>
@@ -8,66 +9,167 @@
 #include <vector>
 
 
+enum class Decay {
+    none,
+    exponential,
+    window
+};
+
+
+// Counts hits and misses per cell. Const methods only read the map and may
+// be called concurrently; get_hits() and get_misses() report the counts 
+// with any pending decay applied, the raw readers return the stored counts
+// without copying them. All other methods, including the single-cell 
+// accessors, apply pending decay in place and require exclusive access to
+// the map.
 template <int N>
-class GridMap {
+class GridMap : public Grid<N> {
 private:
-    std::array<int, N> shape;
-    std::array<double, N> size;
-    std::array<int, N> offset;
-    int elements;
     std::vector<int> hits;
     std::vector<int> misses;
+    Decay decay;
+    int decay_epochs;
+    int epoch;
+    std::vector<int> epochs;
+    std::vector<int> previous_hits;
+    std::vector<int> previous_misses;
 
 public:
     GridMap(
                 std::array<int, N> const & shape, 
                 std::array<double, N> const & size) 
-            : shape(shape), size(size) {
-        if (N <= 0) {
-            throw std::invalid_argument(
-                "Dimensionality of space must be positive.");
+            : Grid<N>(shape, size), decay(Decay::none), decay_epochs(0), 
+              epoch(0) {
+        this->hits.assign(this->elements, 0);
+        this->misses.assign(this->elements, 0);
+    }
+
+protected:
+    // Returns the count of cell i after the decay accumulated since the 
+    // cell was last refreshed. Exponential decay halves the count once per
+    // elapsed half-life. With window decay, "counts" includes the part 
+    // "previous" recorded in the preceding window; one elapsed window drops
+    // that part, two drop everything.
+    int decayed(
+            std::vector<int> const & counts, 
+            std::vector<int> const & previous, 
+            int i) const {
+        if (this->decay == Decay::none) {
+            return counts[i];
         }
 
-        if (*std::min_element(this->shape.begin(), this->shape.end()) < 1 
-                || *std::min_element(
-                        this->size.begin(), this->size.end()) <= 0.0) {
-            throw std::invalid_argument(
-                "Input arguments \"shape\" and \"size\" must be positive.");
+        int const elapsed = this->epoch - this->epochs[i];
+        if (elapsed < this->decay_epochs) {
+            return counts[i];
         }
 
-        this->elements = 1;
-        for (int i = N - 1; i >= 0; --i) {
-            this->offset[i] = this->elements;
-            this->elements *= this->shape[i];
+        int const periods = elapsed / this->decay_epochs;
+        if (this->decay == Decay::exponential) {
+            return periods < 31 ? counts[i] >> periods : 0;
         }
+        return periods == 1 ? counts[i] - previous[i] : 0;
+    }
 
-        this->hits.assign(this->elements, 0);
-        this->misses.assign(this->elements, 0);
+    std::vector<int> decayed(
+            std::vector<int> const & counts, 
+            std::vector<int> const & previous) const {
+        std::vector<int> result(counts);
+        if (this->decay != Decay::none) {
+            for (int i = 0; i < this->elements; ++i) {
+                result[i] = this->decayed(counts, previous, i);
+            }
+        }
+        return result;
     }
 
-protected:
-    int linear_index(std::array<int, N> const & index) const {
-        int linear_index = 0;
-        for (int i = 0; i < N; ++i) {
-            linear_index += index[i] * this->offset[i];
+    bool decayed_equal(
+            std::vector<int> const & counts, 
+            std::vector<int> const & previous,
+            GridMap const & map,
+            std::vector<int> const & map_counts, 
+            std::vector<int> const & map_previous) const {
+        if (this->decay == Decay::none && map.decay == Decay::none) {
+            return counts == map_counts;
+        }
+
+        for (int i = 0; i < this->elements; ++i) {
+            if (this->decayed(counts, previous, i) 
+                    != map.decayed(map_counts, map_previous, i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Stores the decayed counts of cell i. The stamp only advances by whole
+    // half-lives or windows, so frequent updates do not stall the decay.
+    void refresh(int i) {
+        int const elapsed = this->epoch - this->epochs[i];
+        if (elapsed < this->decay_epochs) {
+            return;
+        }
+
+        this->hits[i] = this->decayed(this->hits, this->previous_hits, i);
+        this->misses[i] = this->decayed(this->misses, this->previous_misses, i);
+        if (this->decay == Decay::window) {
+            this->previous_hits[i] = this->hits[i];
+            this->previous_misses[i] = this->misses[i];
+        }
+        this->epochs[i] += elapsed / this->decay_epochs * this->decay_epochs;
+    }
+
+    void refresh() {
+        if (this->decay == Decay::none) {
+            return;
+        }
+
+        for (int i = 0; i < this->elements; ++i) {
+            this->refresh(i);
+        }
+    }
+
+    void touch(int i) {
+        if (this->decay != Decay::none) {
+            this->refresh(i);
         }
-        return linear_index;
     }
 
 public:
     int & get_hit(std::array<int, N> const & index) {
-        return this->hits[this->linear_index(index)];
+        int const i = this->linear_index(index);
+        this->touch(i);
+        return this->hits[i];
     }
 
     int & get_miss(std::array<int, N> const & index) {
-        return this->misses[this->linear_index(index)];
+        int const i = this->linear_index(index);
+        this->touch(i);
+        return this->misses[i];
+    }
+
+    int & get_hit(int linear_index) {
+        this->touch(linear_index);
+        return this->hits[linear_index];
+    }
+
+    int & get_miss(int linear_index) {
+        this->touch(linear_index);
+        return this->misses[linear_index];
     }
 
-    std::vector<int> const & get_hits() const {
+    std::vector<int> get_hits() const {
+        return this->decayed(this->hits, this->previous_hits);
+    }
+
+    std::vector<int> get_misses() const {
+        return this->decayed(this->misses, this->previous_misses);
+    }
+
+    std::vector<int> const & get_raw_hits() const {
         return this->hits;
     }
 
-    std::vector<int> const & get_misses() const {
+    std::vector<int> const & get_raw_misses() const {
         return this->misses;
     }
 
@@ -78,27 +180,76 @@ public:
                 << " elements.";
             throw std::invalid_argument(msg.str());
         }
+        this->refresh();
         this->hits = hits;
+        this->previous_hits.assign(this->previous_hits.size(), 0);
         return *this;
     }
 
     GridMap & set_misses(std::vector<int> const & misses) {
-        if (this->elements != (int)hits.size()) {
+        if (this->elements != (int)misses.size()) {
             std::stringstream msg;
             msg << "Input argument \"misses\" must have " << this->elements
                 << " elements.";
             throw std::invalid_argument(msg.str());
         }
+        this->refresh();
         this->misses = misses;
+        this->previous_misses.assign(this->previous_misses.size(), 0);
+        return *this;
+    }
+
+    // Selects how old evidence fades out. With exponential decay, "epochs" 
+    // is the half-life. With window decay, time is split into windows of 
+    // "epochs" epochs and the map holds the evidence of the current and the
+    // previous window, so evidence expires one to two windows after it was
+    // recorded. Decay is applied lazily whenever a cell is accessed, so 
+    // aging the map costs O(1).
+    GridMap & set_decay(Decay decay, int epochs) {
+        if (decay != Decay::none && epochs < 1) {
+            throw std::invalid_argument(
+                "Input argument \"epochs\" must be positive.");
+        }
+
+        this->refresh();
+        this->decay = decay;
+        if (decay == Decay::none) {
+            this->decay_epochs = 0;
+            this->epochs.clear();
+        } else {
+            this->decay_epochs = epochs;
+            this->epochs.assign(this->elements, this->epoch);
+        }
+
+        if (decay == Decay::window) {
+            this->previous_hits.assign(this->elements, 0);
+            this->previous_misses.assign(this->elements, 0);
+        } else {
+            this->previous_hits.clear();
+            this->previous_misses.clear();
+        }
         return *this;
     }
 
-    std::array<int, N> get_shape() const {
-        return this->shape;
+    GridMap & age(int epochs = 1) {
+        if (epochs < 0) {
+            throw std::invalid_argument(
+                "Input argument \"epochs\" must not be negative.");
+        }
+        this->epoch += epochs;
+        return *this;
+    }
+
+    Decay get_decay() const {
+        return this->decay;
     }
 
-    std::array<double, N> get_size() const {
-        return this->size;
+    int get_decay_epochs() const {
+        return this->decay_epochs;
+    }
+
+    int get_epoch() const {
+        return this->epoch;
     }
 
     bool operator==(GridMap const & map) const {
@@ -110,7 +261,10 @@ public:
             return false;
         }
 
-        if (this->misses != map.misses || this->hits != map.hits) {
+        if (!this->decayed_equal(this->misses, this->previous_misses, 
+                    map, map.misses, map.previous_misses)
+                || !this->decayed_equal(this->hits, this->previous_hits, 
+                    map, map.hits, map.previous_hits)) {
             return false;
         }
 
@@ -123,9 +277,18 @@ public:
                 "Both maps must have the same shapes and sizes.");
         }
 
+        this->refresh();
+        if (map.decay == Decay::none) {
+            for (int i = 0; i < this->elements; ++i) {
+                this->hits[i] += map.hits[i];
+                this->misses[i] += map.misses[i];
+            }
+            return;
+        }
+
         for (int i = 0; i < this->elements; ++i) {
-            this->hits[i] += map.hits[i];
-            this->misses[i] += map.misses[i];
+            this->hits[i] += map.decayed(map.hits, map.previous_hits, i);
+            this->misses[i] += map.decayed(map.misses, map.previous_misses, i);
         }
     }
 };
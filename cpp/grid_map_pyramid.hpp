@@ -0,0 +1,210 @@
+#ifndef GRID_MAP_PYRAMID_H_
+#define GRID_MAP_PYRAMID_H_ GRID_MAP_PYRAMID_H_
+
+#include "grid_map.hpp"
+#include "ray_tracing.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+
+template <int N>
+static void pool_thread(
+        int worker,
+        int workers,
+        std::array<int, N> const & shape,
+        std::array<int, N> const & coarse_shape,
+        int factor,
+        std::vector<int> const & hits,
+        std::vector<int> const & misses,
+        std::vector<int> & coarse_hits,
+        std::vector<int> & coarse_misses) {
+    int row = 1;
+    for (int i = 1; i < N; ++i) {
+        row *= shape[i];
+    }
+
+    std::array<int, N> coarse_offset;
+    int elements = 1;
+    for (int i = N - 1; i >= 0; --i) {
+        coarse_offset[i] = elements;
+        elements *= coarse_shape[i];
+    }
+
+    for (int r = worker; r < coarse_shape[0]; r += workers) {
+        int const first = r * factor * row;
+        int const last = std::min(shape[0], (r + 1) * factor) * row;
+        for (int i = first; i < last; ++i) {
+            int rest = i;
+            int coarse_index = 0;
+            for (int d = N - 1; d >= 0; --d) {
+                coarse_index += (rest % shape[d]) / factor * coarse_offset[d];
+                rest /= shape[d];
+            }
+            coarse_hits[coarse_index] += hits[i];
+            coarse_misses[coarse_index] += misses[i];
+        }
+    }
+}
+
+
+// Sums the hits and misses of blocks of "factor" cells per dimension into
+// a map whose cells have size "coarse_size".
+template <int N>
+GridMap<N> pool(
+        GridMap<N> const & map, 
+        int factor, 
+        std::array<double, N> const & coarse_size) {
+    if (factor < 1) {
+        throw std::invalid_argument(
+            "Input argument \"factor\" must be positive.");
+    }
+
+    std::array<int, N> const shape = map.get_shape();
+    std::array<int, N> coarse_shape;
+    for (int i = 0; i < N; ++i) {
+        coarse_shape[i] = (shape[i] + factor - 1) / factor;
+    }
+    GridMap<N> coarse_map(coarse_shape, coarse_size);
+
+    std::vector<int> decayed_hits;
+    std::vector<int> decayed_misses;
+    if (map.get_decay() != Decay::none) {
+        decayed_hits = map.get_hits();
+        decayed_misses = map.get_misses();
+    }
+    std::vector<int> const & hits = map.get_decay() == Decay::none 
+        ? map.get_raw_hits() : decayed_hits;
+    std::vector<int> const & misses = map.get_decay() == Decay::none 
+        ? map.get_raw_misses() : decayed_misses;
+    std::vector<int> coarse_hits(coarse_map.get_raw_hits().size(), 0);
+    std::vector<int> coarse_misses(coarse_hits.size(), 0);
+
+    std::vector<std::thread> threads;
+    int const workers = std::max(1, std::min<int>(
+        coarse_shape[0], std::thread::hardware_concurrency()));
+    for (int i = 0; i < workers; ++i) {
+        threads.push_back(std::thread(
+            pool_thread<N>,
+            i,
+            workers,
+            std::cref(shape),
+            std::cref(coarse_shape),
+            factor,
+            std::cref(hits),
+            std::cref(misses),
+            std::ref(coarse_hits),
+            std::ref(coarse_misses)));
+    }
+
+    for (int i = 0; i < workers; ++i) {
+        threads[i].join();
+    }
+
+    coarse_map.set_hits(coarse_hits).set_misses(coarse_misses);
+    return coarse_map;
+}
+
+
+template <int N>
+GridMap<N> pool(GridMap<N> const & map, int factor) {
+    std::array<double, N> coarse_size = map.get_size();
+    for (int i = 0; i < N; ++i) {
+        coarse_size[i] *= factor;
+    }
+    return pool<N>(map, factor, coarse_size);
+}
+
+
+// Stack of maps whose cells grow by "factor" from one level to the next.
+// Only the finest level is traced; coarser levels are obtained by summing
+// the hits and misses of the underlying cells.
+template <int N>
+class GridMapPyramid {
+private:
+    int factor;
+    std::vector<GridMap<N>> levels;
+
+public:
+    GridMapPyramid(
+                std::array<int, N> const & shape,
+                std::array<double, N> const & size,
+                int levels,
+                int factor = 2)
+            : factor(factor) {
+        if (levels < 1 || factor < 1) {
+            throw std::invalid_argument(
+                "Input arguments \"levels\" and \"factor\" must be positive.");
+        }
+
+        this->levels.push_back(GridMap<N>(shape, size));
+        for (int i = 1; i < levels; ++i) {
+            this->levels.push_back(pool<N>(
+                this->levels.back(), factor, this->level_size(i)));
+        }
+    }
+
+private:
+    // Returns the cell size of the given level. It is computed from the
+    // finest level so that rounding errors do not add up across levels.
+    std::array<double, N> level_size(int level) const {
+        std::array<double, N> size = this->levels[0].get_size();
+        for (int i = 0; i < N; ++i) {
+            size[i] *= std::pow((double)this->factor, level);
+        }
+        return size;
+    }
+
+    // Pools every level from the next finer one. Pooling twice by "factor"
+    // sums the same cells as pooling once by its square, so this matches 
+    // pooling the finest level directly at a fraction of the cost.
+    void rebuild() {
+        for (int i = 1; i < (int)this->levels.size(); ++i) {
+            this->levels[i] = pool<N>(
+                this->levels[i - 1], this->factor, this->level_size(i));
+        }
+    }
+
+public:
+    // Adds the hits and misses of a map with the geometry of the finest
+    // level and rebuilds the coarser levels.
+    GridMapPyramid & add(GridMap<N> const & map) {
+        this->levels[0] += map;
+        this->rebuild();
+        return *this;
+    }
+
+    GridMapPyramid & trace(
+            std::vector<std::array<double, N>> const & start,
+            std::vector<std::array<double, N>> const & end) {
+        trace_rays<N>(start, end, this->levels[0]);
+        this->rebuild();
+        return *this;
+    }
+
+    GridMap<N> const & get_level(int level) const {
+        if (level < 0 || level >= (int)this->levels.size()) {
+            std::stringstream msg;
+            msg << "Input argument \"level\" must be in [0, "
+                << this->levels.size() << ").";
+            throw std::out_of_range(msg.str());
+        }
+        return this->levels[level];
+    }
+
+    int get_levels() const {
+        return this->levels.size();
+    }
+
+    int get_factor() const {
+        return this->factor;
+    }
+};
+
+
+#endif
@@ -1,21 +1,55 @@
 #ifndef RAYTRACING_H_
 #define RAYTRACING_H_ RAYTRACING_H_
 
+#include "grid.hpp"
 #include "grid_map.hpp"
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <exception>
+#include <functional>
 #include <mutex>
 #include <sstream>
 #include <thread>
 #include <vector>
 
 
+// Policies define what happens to the cells a ray passes. "traverse" is 
+// called for every cell the ray crosses, "reflect" for the cell containing 
+// the endpoint if it lies inside the map. A policy may act on any map type 
+// that provides get_shape(), get_size(), a (shape, size) constructor, and
+// operator+= for merging the maps of the worker threads.
 template <int N>
+struct HitMissPolicy {
+    void traverse(GridMap<N> & map, std::array<int, N> const & index) const {
+        map.get_miss(index)++;
+    }
+
+    void reflect(GridMap<N> & map, std::array<int, N> const & index) const {
+        map.get_hit(index)++;
+    }
+};
+
+
+// Counts the endpoint cell as a miss, e.g. for max-range returns.
+template <int N>
+struct ClearPolicy {
+    void traverse(GridMap<N> & map, std::array<int, N> const & index) const {
+        map.get_miss(index)++;
+    }
+
+    void reflect(GridMap<N> & map, std::array<int, N> const & index) const {
+        map.get_miss(index)++;
+    }
+};
+
+
+template <int N, typename Policy = HitMissPolicy<N>, typename Map = GridMap<N>>
 void trace_ray(
         std::array<double, N> const & start, 
         std::array<double, N> const & end,
-        GridMap<N> & map) {
+        Map & map,
+        Policy const & policy = Policy()) {
     std::array<double, N> const & u(start);
     std::array<double, N> v(end);
     for (int i = 0; i < N; ++i) {
@@ -47,7 +81,6 @@ void trace_ray(
     for (int i = 0; i < N; ++i) {
         index[i] = std::min(shape[i] - 1, (int)((u[i] + t * v[i]) / size[i]));
     }
-    map.get_miss(index)++;
 
     std::array<int, N> step;
     for (int i = 0; i < N; ++i) {
@@ -66,6 +99,8 @@ void trace_ray(
     }
 
     while ((t = *std::min_element(t_max.begin(), t_max.end())) < 1.0) {
+        policy.traverse(map, index);
+
         for (int i = 0; i < N; ++i) {
             if (t_max[i] == t) {
                 index[i] += step[i];
@@ -78,61 +113,415 @@ void trace_ray(
                 t_max[i] = (next_index * size[i] - u[i]) / v[i];
             }
         }
+    }
 
-        map.get_miss(index)++;
+    policy.reflect(map, index);
+}
+
+
+// Forwards all updates to "policy" and records the endpoint cell reported 
+// by the traversal.
+template <int N, typename Policy>
+struct EndpointPolicy {
+    Policy const & policy;
+    std::array<int, N> * endpoint;
+
+    template <typename Map>
+    void traverse(Map & map, std::array<int, N> const & index) const {
+        this->policy.traverse(map, index);
+    }
+
+    template <typename Map>
+    void reflect(Map & map, std::array<int, N> const & index) const {
+        *this->endpoint = index;
+        this->policy.reflect(map, index);
+    }
+};
+
+
+// Applies "reflect" to all cells except the endpoint cell, which has 
+// already been updated by the ray itself.
+template <int N, typename Policy>
+struct BehindPolicy {
+    Policy const & policy;
+    std::array<int, N> endpoint;
+
+    template <typename Map>
+    void traverse(Map & map, std::array<int, N> const & index) const {
+        if (index != this->endpoint) {
+            this->policy.reflect(map, index);
+        }
     }
 
-    map.get_miss(index)--;
-    map.get_hit(index)++;
+    template <typename Map>
+    void reflect(Map & map, std::array<int, N> const & index) const {
+        this->traverse(map, index);
+    }
+};
+
+
+inline void check_band(double before, double behind) {
+    if (!(before >= 0.0) || !(behind >= 0.0)) {
+        throw std::invalid_argument(
+            "Input arguments \"before\" and \"behind\" must not be "
+            "negative.");
+    }
 }
 
 
-std::mutex map_mutex;
+// Only updates the cells up to "before" in front of the endpoint and the 
+// cells up to "behind" beyond it; the latter are treated like the endpoint
+// cell. Traversal starts directly at the band, so the cost depends on the
+// band width instead of the ray length. If "free_map" is given, the 
+// skipped part of the ray is traced as free space in that, typically 
+// coarser, map.
+template <int N, typename Policy = HitMissPolicy<N>, typename Map = GridMap<N>>
+void trace_ray_band(
+        std::array<double, N> const & start, 
+        std::array<double, N> const & end,
+        Map & map,
+        double before,
+        double behind = 0.0,
+        GridMap<N> * free_map = nullptr,
+        Policy const & policy = Policy()) {
+    check_band(before, behind);
+
+    std::array<double, N> v(end);
+    double length = 0.0;
+    for (int i = 0; i < N; ++i) {
+        v[i] -= start[i];
+        length += v[i] * v[i];
+    }
+    length = std::sqrt(length);
+
+    std::array<int, N> endpoint;
+    endpoint.fill(-1);
+    EndpointPolicy<N, Policy> const endpoint_policy = {policy, &endpoint};
+    if (length <= before) {
+        trace_ray<N>(start, end, map, endpoint_policy);
+    } else {
+        std::array<double, N> band_start;
+        double const t = 1.0 - before / length;
+        for (int i = 0; i < N; ++i) {
+            band_start[i] = start[i] + t * v[i];
+        }
+        trace_ray<N>(band_start, end, map, endpoint_policy);
 
+        if (free_map != nullptr) {
+            trace_ray<N>(start, band_start, *free_map, ClearPolicy<N>());
+        }
+    }
 
+    if (!(behind > 0.0 && length > 0.0) || endpoint[0] < 0) {
+        return;
+    }
+
+    std::array<double, N> behind_end;
+    for (int i = 0; i < N; ++i) {
+        behind_end[i] = end[i] + behind / length * v[i];
+    }
+
+    BehindPolicy<N, Policy> const behind_policy = {policy, endpoint};
+    trace_ray<N>(end, behind_end, map, behind_policy);
+}
+
+
+// Records the linear indices of all cells a ray passes, in traversal order.
 template <int N>
+struct CellListPolicy {
+    std::vector<int> * cells;
+
+    void traverse(
+            Grid<N> const & grid, std::array<int, N> const & index) const {
+        this->cells->push_back(grid.linear_index(index));
+    }
+
+    void reflect(
+            Grid<N> const & grid, std::array<int, N> const & index) const {
+        this->cells->push_back(grid.linear_index(index));
+    }
+};
+
+
+std::mutex map_mutex;
+
+
+// Calls "trace(i, map, free_map)" for every ray i on per-worker copies of 
+// "map" and, if given, "free_map", and merges the copies afterwards.
+template <int N, typename Map, typename Trace>
 static void trace_ray_thread(
         int worker,
-        std::vector<std::array<double, N>> const & start,
-        std::vector<std::array<double, N>> const & end,
-        GridMap<N> & map) {
-    int const workers = std::thread::hardware_concurrency();
-    GridMap<N> worker_map(map.get_shape(), map.get_size());
-    for (int i = worker; i < (int)start.size(); i += workers) {
-        trace_ray<N>(start[i], end[i], worker_map);
+        int workers,
+        int rays,
+        Map & map,
+        GridMap<N> * free_map,
+        Trace const & trace) {
+    Map worker_map(map.get_shape(), map.get_size());
+    std::vector<GridMap<N>> worker_free_map;
+    if (free_map != nullptr) {
+        worker_free_map.push_back(
+            GridMap<N>(free_map->get_shape(), free_map->get_size()));
+    }
+
+    for (int i = worker; i < rays; i += workers) {
+        trace(i, worker_map,
+            worker_free_map.empty() ? nullptr : &worker_free_map[0]);
     }
 
     map_mutex.lock();
     map += worker_map;
+    if (free_map != nullptr) {
+        *free_map += worker_free_map[0];
+    }
     map_mutex.unlock();
 }
 
 
-template<int N>
+template <int N, typename Map, typename Trace>
+void trace_parallel(
+        int rays,
+        Map & map,
+        GridMap<N> * free_map,
+        Trace const & trace) {
+    if (rays == 0) {
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    int const workers = std::max(1, std::min<int>(
+        rays, std::thread::hardware_concurrency()));
+    for (int i = 0; i < workers; ++i) {
+        threads.push_back(std::thread(
+            trace_ray_thread<N, Map, Trace>, 
+            i,
+            workers,
+            rays,
+            std::ref(map),
+            free_map,
+            std::cref(trace)));
+    }
+
+    for (int i = 0; i < workers; ++i) {
+        threads[i].join();
+    }
+}
+
+
+template <int N, typename Policy = HitMissPolicy<N>, typename Map = GridMap<N>>
 void trace_rays(
         std::vector<std::array<double, N>> const & start,
         std::vector<std::array<double, N>> const & end,
-        GridMap<N> & map) {
+        Map & map,
+        Policy const & policy = Policy()) {
+    if (start.size() != end.size()) {
+        throw std::invalid_argument(
+            "Input arguments \"start\" and \"end\" must be of equal size.");
+    }
+
+    trace_parallel<N>(start.size(), map, nullptr, 
+        [&](int i, Map & worker_map, GridMap<N> *) {
+            trace_ray<N>(start[i], end[i], worker_map, policy);
+        });
+}
+
+
+template <int N, typename Policy = HitMissPolicy<N>, typename Map = GridMap<N>>
+void trace_rays_band(
+        std::vector<std::array<double, N>> const & start,
+        std::vector<std::array<double, N>> const & end,
+        Map & map,
+        double before,
+        double behind = 0.0,
+        GridMap<N> * free_map = nullptr,
+        Policy const & policy = Policy()) {
+    if (start.size() != end.size()) {
+        throw std::invalid_argument(
+            "Input arguments \"start\" and \"end\" must be of equal size.");
+    }
+    check_band(before, behind);
+
+    trace_parallel<N>(start.size(), map, free_map, 
+        [&](int i, Map & worker_map, GridMap<N> * worker_free_map) {
+            trace_ray_band<N>(start[i], end[i], worker_map, before, behind,
+                worker_free_map, policy);
+        });
+}
+
+
+template <int N>
+static void trace_cells_thread(
+        int first,
+        int last,
+        std::vector<std::array<double, N>> const & start,
+        std::vector<std::array<double, N>> const & end,
+        Grid<N> const & grid,
+        std::vector<int> & offsets,
+        std::vector<int> & cells) {
+    std::array<int, N> const & shape = grid.get_shape();
+    std::array<double, N> const & size = grid.get_size();
+
+    double length = 0.0;
+    for (int i = first; i < last; ++i) {
+        length += 1.0;
+        for (int d = 0; d < N; ++d) {
+            length += std::min<double>(
+                std::abs(end[i][d] - start[i][d]) / size[d] + 1.0, 
+                shape[d] - 1);
+        }
+    }
+    cells.reserve((size_t)length);
+
+    CellListPolicy<N> const policy = {&cells};
+    for (int i = first; i < last; ++i) {
+        int const cells_before = cells.size();
+        trace_ray<N>(start[i], end[i], grid, policy);
+        offsets[i + 1] = cells.size() - cells_before;
+    }
+}
+
+
+// Lists the cells traversed by each ray in compressed sparse row form: the 
+// linear indices of the cells passed by ray i are stored in 
+// cells[offsets[i]] to cells[offsets[i + 1] - 1]. Each worker traces a 
+// contiguous block of rays and, once the offsets are known, writes its 
+// cells into its own slice of the result.
+template <int N>
+void trace_cells(
+        std::vector<std::array<double, N>> const & start,
+        std::vector<std::array<double, N>> const & end,
+        Grid<N> const & grid,
+        std::vector<int> & offsets,
+        std::vector<int> & cells) {
     if (start.size() != end.size()) {
         throw std::invalid_argument(
             "Input arguments \"start\" and \"end\" must be of equal size.");
     }
 
+    int const rays = start.size();
+    offsets.assign(rays + 1, 0);
+    if (rays == 0) {
+        cells.clear();
+        return;
+    }
+
     std::vector<std::thread> threads;
-    int const workers = std::min<int>(
-        start.size(), std::thread::hardware_concurrency());
+    int const workers = std::max(1, std::min<int>(
+        rays, std::thread::hardware_concurrency()));
+    std::vector<int> first(workers + 1);
+    std::vector<std::vector<int>> worker_cells(workers);
+    for (int i = 0; i <= workers; ++i) {
+        first[i] = (int)((long)rays * i / workers);
+    }
     for (int i = 0; i < workers; ++i) {
         threads.push_back(std::thread(
-            trace_ray_thread<N>, 
-            i,
-            std::cref(start), 
+            trace_cells_thread<N>,
+            first[i],
+            first[i + 1],
+            std::cref(start),
             std::cref(end),
-            std::ref(map)));
+            std::cref(grid),
+            std::ref(offsets),
+            std::ref(worker_cells[i])));
     }
 
     for (int i = 0; i < workers; ++i) {
         threads[i].join();
     }
+
+    for (int i = 0; i < rays; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    cells.resize(offsets[rays]);
+    for (int i = 0; i < workers; ++i) {
+        threads[i] = std::thread([&, i]() {
+            std::copy(worker_cells[i].begin(), worker_cells[i].end(), 
+                cells.begin() + offsets[first[i]]);
+            std::vector<int>().swap(worker_cells[i]);
+        });
+    }
+
+    for (int i = 0; i < workers; ++i) {
+        threads[i].join();
+    }
+}
+
+
+// Traces an organized range image with one row per elevation and one 
+// column per azimuth angle, as delivered by spinning lidars. "rotation" 
+// maps beam directions from the sensor frame into the map frame. Ray 
+// endpoints are generated inside the worker threads, each of which traces
+// a contiguous block of beams in row-major order. Returns that are not 
+// positive or NaN are skipped; returns at or beyond "max_range" only clear
+// space.
+inline void trace_range_image(
+        std::vector<double> const & ranges,
+        std::vector<double> const & elevation,
+        std::vector<double> const & azimuth,
+        std::array<double, 3> const & position,
+        std::array<std::array<double, 3>, 3> const & rotation,
+        double max_range,
+        GridMap<3> & map) {
+    if (ranges.size() != elevation.size() * azimuth.size()) {
+        throw std::invalid_argument(
+            "Input argument \"ranges\" must have one element per "
+            "elevation and azimuth angle.");
+    }
+
+    if (!(max_range > 0.0)) {
+        throw std::invalid_argument(
+            "Input argument \"max_range\" must be positive.");
+    }
+
+    std::vector<double> cos_elevation(elevation.size());
+    std::vector<double> sin_elevation(elevation.size());
+    for (int i = 0; i < (int)elevation.size(); ++i) {
+        cos_elevation[i] = std::cos(elevation[i]);
+        sin_elevation[i] = std::sin(elevation[i]);
+    }
+
+    std::vector<double> cos_azimuth(azimuth.size());
+    std::vector<double> sin_azimuth(azimuth.size());
+    for (int i = 0; i < (int)azimuth.size(); ++i) {
+        cos_azimuth[i] = std::cos(azimuth[i]);
+        sin_azimuth[i] = std::sin(azimuth[i]);
+    }
+
+    int const columns = azimuth.size();
+    int const beams = ranges.size();
+    int const blocks = std::max(1, std::min<int>(
+        beams, std::thread::hardware_concurrency()));
+    trace_parallel<3>(blocks, map, nullptr,
+        [&](int block, GridMap<3> & worker_map, GridMap<3> *) {
+            int const first = (int)((long)beams * block / blocks);
+            int const last = (int)((long)beams * (block + 1) / blocks);
+            std::array<double, 3> end;
+            for (int b = first; b < last; ++b) {
+                double const range = ranges[b];
+                if (!(range > 0.0)) {
+                    continue;
+                }
+
+                int const r = b / columns;
+                int const c = b % columns;
+                std::array<double, 3> const direction = {
+                    cos_elevation[r] * cos_azimuth[c],
+                    cos_elevation[r] * sin_azimuth[c],
+                    sin_elevation[r]};
+                for (int i = 0; i < 3; ++i) {
+                    end[i] = position[i] + std::min(range, max_range) * (
+                        rotation[i][0] * direction[0] 
+                        + rotation[i][1] * direction[1] 
+                        + rotation[i][2] * direction[2]);
+                }
+
+                if (range < max_range) {
+                    trace_ray<3>(position, end, worker_map);
+                } else {
+                    trace_ray<3>(position, end, worker_map, ClearPolicy<3>());
+                }
+            }
+        });
 }
 
 
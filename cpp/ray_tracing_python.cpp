@@ -1,12 +1,62 @@
+#include "grid.hpp"
 #include "grid_map.hpp"
+#include "grid_map_pyramid.hpp"
 #include "ray_tracing.hpp"
+#include "traversal_cache.hpp"
 #include <array>
+#include <utility>
 #include <vector>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 
 
+template <typename T>
+void register_vector(pybind11::module & module) {
+    std::stringstream name;
+    name << "v" << typeid(T).name();
+    pybind11::class_<std::vector<T>>(
+            module, 
+            name.str().c_str(),
+            pybind11::buffer_protocol())
+        .def(pybind11::init([](pybind11::buffer buffer) {
+            pybind11::buffer_info info = buffer.request();
+            
+            if (info.format != pybind11::format_descriptor<T>::format()) {
+                std::stringstream msg;
+                msg << "Input array must be of type " 
+                    << typeid(T).name() << ".";
+                throw std::runtime_error(msg.str());
+            }
+
+            if (info.ndim != 1) {
+                throw std::runtime_error("Input array must be 1D.");
+            }
+
+            std::vector<T> vector;
+            vector.reserve((size_t)info.shape[0]);
+            ssize_t step = info.strides[0] / static_cast<ssize_t>(sizeof(T));
+            T * data = static_cast<T *>(info.ptr);
+            T * end = data + info.shape[0] * step;
+            for (T * data = static_cast<T *>(info.ptr); 
+                    data != end; 
+                    data += step) {
+                vector.push_back(*data);
+            }
+            return vector;
+        }))
+        .def_buffer([](std::vector<T> & vector) -> pybind11::buffer_info {
+            return pybind11::buffer_info(
+                vector.data(),
+                sizeof(T),
+                pybind11::format_descriptor<T>::format(),
+                1,
+                {vector.size()},
+                {sizeof(T)});
+        });
+}
+
+
 template <typename T, int N>
 void register_vector_array(pybind11::module & module) {
     std::stringstream name;
@@ -71,9 +121,82 @@ void register_map(pybind11::module & module) {
         .def(pybind11::init<std::array<int, N> const &, 
             std::array<double, N> const &>())
         .def_property("hits",
-            &GridMap<N>::get_hits, &GridMap<N>::set_hits)
+            [](pybind11::object self) {
+                GridMap<N> const & map = self.cast<GridMap<N> const &>();
+                if (map.get_decay() == Decay::none) {
+                    return pybind11::cast(map.get_raw_hits(), 
+                        pybind11::return_value_policy::reference_internal, 
+                        self);
+                }
+                return pybind11::cast(map.get_hits());
+            }, 
+            &GridMap<N>::set_hits)
         .def_property("misses",
-            &GridMap<N>::get_misses, &GridMap<N>::set_misses);
+            [](pybind11::object self) {
+                GridMap<N> const & map = self.cast<GridMap<N> const &>();
+                if (map.get_decay() == Decay::none) {
+                    return pybind11::cast(map.get_raw_misses(), 
+                        pybind11::return_value_policy::reference_internal, 
+                        self);
+                }
+                return pybind11::cast(map.get_misses());
+            }, 
+            &GridMap<N>::set_misses)
+        .def("set_decay", &GridMap<N>::set_decay,
+            pybind11::arg("decay"), pybind11::arg("epochs"),
+            pybind11::return_value_policy::reference_internal)
+        .def("age", &GridMap<N>::age, pybind11::arg("epochs") = 1,
+            pybind11::return_value_policy::reference_internal)
+        .def_property_readonly("decay", &GridMap<N>::get_decay)
+        .def_property_readonly("decay_epochs", &GridMap<N>::get_decay_epochs)
+        .def_property_readonly("epoch", &GridMap<N>::get_epoch)
+        .def_property_readonly("shape", [](GridMap<N> const & map) {
+            return map.get_shape();
+        })
+        .def_property_readonly("size", [](GridMap<N> const & map) {
+            return map.get_size();
+        });
+}
+
+
+template <int N>
+void register_pyramid(pybind11::module & module) {
+    std::stringstream name;
+    name << "gridmappyramid" << N;
+    pybind11::class_<GridMapPyramid<N>>(module, name.str().c_str())
+        .def(pybind11::init<std::array<int, N> const &, 
+                std::array<double, N> const &, int, int>(),
+            pybind11::arg("shape"), pybind11::arg("size"), 
+            pybind11::arg("levels"), pybind11::arg("factor") = 2)
+        .def("add", &GridMapPyramid<N>::add, pybind11::arg("map"),
+            pybind11::return_value_policy::reference_internal)
+        .def("trace", &GridMapPyramid<N>::trace, 
+            pybind11::arg("start"), pybind11::arg("end"),
+            pybind11::return_value_policy::reference_internal)
+        .def("level", &GridMapPyramid<N>::get_level, pybind11::arg("level"),
+            pybind11::return_value_policy::reference_internal)
+        .def_property_readonly("levels", &GridMapPyramid<N>::get_levels)
+        .def_property_readonly("factor", &GridMapPyramid<N>::get_factor);
+}
+
+
+template <int N>
+void register_cache(pybind11::module & module) {
+    std::stringstream name;
+    name << "traversalcache" << N;
+    pybind11::class_<TraversalCache<N>>(module, name.str().c_str())
+        .def(pybind11::init<std::array<double, N> const &, 
+                std::vector<std::array<double, N>> const &, double, int,
+                GridMap<N> const &>(),
+            pybind11::arg("origin"), pybind11::arg("directions"), 
+            pybind11::arg("bin_width"), pybind11::arg("bins"),
+            pybind11::arg("map"))
+        .def("apply", &TraversalCache<N>::apply, 
+            pybind11::arg("ranges"), pybind11::arg("map"))
+        .def_property_readonly("memory", &TraversalCache<N>::get_memory)
+        .def_property_readonly("beams", &TraversalCache<N>::get_beams)
+        .def_property_readonly("bins", &TraversalCache<N>::get_bins)
+        .def_property_readonly("bin_width", &TraversalCache<N>::get_bin_width);
 }
 
 
@@ -83,8 +206,52 @@ void register_function(pybind11::module & module) {
     name << "trace" << N << "d";
     std::stringstream description;
     description << "Amanatides-Woo ray tracing in " << N << "D";
-    module.def(name.str().c_str(), &trace_rays<N>, description.str().c_str(),
+    module.def(name.str().c_str(), 
+        [](std::vector<std::array<double, N>> const & start,
+                std::vector<std::array<double, N>> const & end,
+                GridMap<N> & map) {
+            trace_rays<N>(start, end, map);
+        },
+        description.str().c_str(),
         pybind11::arg("start"), pybind11::arg("end"), pybind11::arg("map"));
+
+    std::stringstream band_name;
+    band_name << "trace_band" << N << "d";
+    std::stringstream band_description;
+    band_description << "Amanatides-Woo ray tracing in " << N 
+        << "D restricted to a band around the endpoints";
+    module.def(band_name.str().c_str(), 
+        [](std::vector<std::array<double, N>> const & start,
+                std::vector<std::array<double, N>> const & end,
+                GridMap<N> & map,
+                double before,
+                double behind,
+                GridMap<N> * free_map) {
+            trace_rays_band<N>(start, end, map, before, behind, free_map);
+        },
+        band_description.str().c_str(),
+        pybind11::arg("start"), pybind11::arg("end"), pybind11::arg("map"),
+        pybind11::arg("before"), pybind11::arg("behind") = 0.0,
+        pybind11::arg("free_map") = pybind11::none());
+
+    std::stringstream cells_name;
+    cells_name << "trace_cells" << N << "d";
+    std::stringstream cells_description;
+    cells_description << "Cells traversed by each ray in " << N 
+        << "D as offsets and linear cell indices";
+    module.def(cells_name.str().c_str(), 
+        [](std::vector<std::array<double, N>> const & start,
+                std::vector<std::array<double, N>> const & end,
+                std::array<int, N> const & shape,
+                std::array<double, N> const & size) {
+            std::pair<std::vector<int>, std::vector<int>> csr;
+            trace_cells<N>(
+                start, end, Grid<N>(shape, size), csr.first, csr.second);
+            return csr;
+        },
+        cells_description.str().c_str(),
+        pybind11::arg("start"), pybind11::arg("end"), 
+        pybind11::arg("shape"), pybind11::arg("size"));
 }
 
 
@@ -93,11 +260,14 @@ void register_all(pybind11::module & module) {
     register_vector_array<double, N>(module);
     register_vector_array<int, N>(module);
     register_map<N>(module);
+    register_pyramid<N>(module);
+    register_cache<N>(module);
     register_function<N>(module);
 }
 
 
 PYBIND11_MAKE_OPAQUE(std::vector<int>);
+PYBIND11_MAKE_OPAQUE(std::vector<double>);
 PYBIND11_MAKE_OPAQUE(std::vector<std::array<double, 1>>);
 PYBIND11_MAKE_OPAQUE(std::vector<std::array<int, 1>>);
 PYBIND11_MAKE_OPAQUE(std::vector<std::array<double, 2>>);
@@ -109,47 +279,24 @@ PYBIND11_MAKE_OPAQUE(std::vector<std::array<int, 3>>);
 PYBIND11_PLUGIN(ray_tracing_python) {
     pybind11::module module("ray_tracing_python", "Amanatides-Woo ray tracing");
 
-    pybind11::class_<std::vector<int>>(
-            module, 
-            "vi", 
-            pybind11::buffer_protocol())
-        .def(pybind11::init([](pybind11::buffer buffer) {
-            pybind11::buffer_info info = buffer.request();
-            
-            if (info.format != pybind11::format_descriptor<int>::format()) {
-                throw std::runtime_error(
-                    "Input array must be of type \"int\".");
-            }
-
-            if (info.ndim != 1) {
-                throw std::runtime_error("Input array must be 1D.");
-            }
+    register_vector<int>(module);
+    register_vector<double>(module);
 
-            std::vector<int> vector;
-            vector.reserve((size_t)info.shape[0]);
-            ssize_t step = info.strides[0] / static_cast<ssize_t>(sizeof(int));
-            int * data = static_cast<int *>(info.ptr);
-            int * end = data + info.shape[0] * step;
-            for (int * data = static_cast<int *>(info.ptr); 
-                    data != end; 
-                    data += step) {
-                vector.push_back(*data);
-            }
-            return vector;
-        }))
-        .def_buffer([](std::vector<int> & vector) -> pybind11::buffer_info {
-            return pybind11::buffer_info(
-                vector.data(),
-                sizeof(int),
-                pybind11::format_descriptor<int>::format(),
-                1,
-                {vector.size()},
-                {sizeof(int)});
-        });
+    pybind11::enum_<Decay>(module, "decay")
+        .value("none", Decay::none)
+        .value("exponential", Decay::exponential)
+        .value("window", Decay::window);
 
     register_all<1>(module);
     register_all<2>(module);
     register_all<3>(module);
 
+    module.def("trace_range_image", &trace_range_image, 
+        "Amanatides-Woo ray tracing of an organized 3D range image",
+        pybind11::arg("ranges"), pybind11::arg("elevation"), 
+        pybind11::arg("azimuth"), pybind11::arg("position"), 
+        pybind11::arg("rotation"), pybind11::arg("max_range"), 
+        pybind11::arg("map"));
+
     return module.ptr();
 }
@@ -1,6 +1,8 @@
 #define CATCH_CONFIG_MAIN
+#include "grid_map_pyramid.hpp"
 #include "ray_tracing.hpp"
 #include "test_ray_tracing.hpp"
+#include "traversal_cache.hpp"
 #include <array>
 #include <catch2/catch.hpp>
 #include <random>
@@ -312,3 +314,705 @@ TEST_CASE("random parallel ray tracing (4D)", "[4D]") {
 TEST_CASE("random parallel ray tracing (5D)", "[5D]") {
     random_test_parallel<5>();
 }
+
+
+TEST_CASE("exponential decay of evidence (1D)", "[1D]") {
+    std::array<double, 1> start = {0.671};
+    std::array<double, 1> end = {0.985};
+    std::array<int, 1> shape = {100};
+    std::array<double, 1> size = {0.01};
+
+    GridMap<1> map_gt(shape, size);
+    int i;
+    for (i = 67; i < 98; ++i) {
+        map_gt.get_miss({i}) = 3;
+    }
+    map_gt.get_hit({i}) = 3;
+
+    GridMap<1> map(shape, size);
+    map.set_decay(Decay::exponential, 2);
+    for (int j = 0; j < 13; ++j) {
+        trace_ray<1>(start, end, map);
+    }
+    map.age(5);
+    REQUIRE(map_gt == map);
+    // Reading the map must not apply its decay a second time.
+    REQUIRE(map_gt == map);
+
+    map.age(1);
+    for (i = 67; i < 98; ++i) {
+        map_gt.get_miss({i}) = 1;
+    }
+    map_gt.get_hit({i}) = 1;
+    REQUIRE(map_gt == map);
+}
+
+
+TEST_CASE("window decay of evidence (1D)", "[1D]") {
+    std::array<int, 1> shape = {100};
+    std::array<double, 1> size = {0.01};
+
+    GridMap<1> map(shape, size);
+    map.set_decay(Decay::window, 4);
+    trace_ray<1>({0.001}, {0.495}, map);
+    map.age(3);
+    trace_ray<1>({0.301}, {0.795}, map);
+
+    GridMap<1> map_gt(shape, size);
+    trace_ray<1>({0.001}, {0.495}, map_gt);
+    trace_ray<1>({0.301}, {0.795}, map_gt);
+    REQUIRE(map_gt == map);
+
+    map.age(1);
+    REQUIRE(map_gt == map);
+
+    trace_ray<1>({0.501}, {0.995}, map);
+    trace_ray<1>({0.501}, {0.995}, map_gt);
+    map.age(3);
+    REQUIRE(map_gt == map);
+
+    map.age(1);
+    map_gt = GridMap<1>(shape, size);
+    trace_ray<1>({0.501}, {0.995}, map_gt);
+    REQUIRE(map_gt == map);
+
+    map.age(4);
+    REQUIRE(GridMap<1>(shape, size) == map);
+}
+
+
+TEST_CASE("window decay of continuously updated cell (1D)", "[1D]") {
+    std::array<int, 1> shape = {10};
+    std::array<double, 1> size = {1.0};
+
+    GridMap<1> map(shape, size);
+    map.set_decay(Decay::window, 2);
+    trace_ray<1>({0.5}, {1.5}, map);
+    REQUIRE(map.get_hits()[1] == 1);
+
+    for (int i = 0; i < 100; ++i) {
+        map.age(1);
+        REQUIRE(map.get_hits()[1] + map.get_misses()[1] > 0);
+        trace_ray<1>({0.5}, {5.5}, map);
+    }
+    REQUIRE(map.get_hits()[1] == 0);
+    REQUIRE(map.get_misses()[1] == 3);
+}
+
+
+TEST_CASE("parallel ray tracing into decaying map (2D)", "[2D]") {
+    std::default_random_engine gen;
+    std::uniform_real_distribution<double> point_dist(-1.0, 11.0);
+
+    int const rays = 1000;
+    std::vector<std::array<double, 2>> start(rays);
+    std::vector<std::array<double, 2>> end(rays);
+    for (int i = 0; i < rays; ++i) {
+        for (int d = 0; d < 2; ++d) {
+            start[i][d] = point_dist(gen);
+            end[i][d] = point_dist(gen);
+        }
+    }
+
+    std::array<int, 2> shape = {20, 20};
+    std::array<double, 2> size = {0.5, 0.5};
+    for (Decay decay : {Decay::exponential, Decay::window}) {
+        GridMap<2> map_sequential(shape, size);
+        map_sequential.set_decay(decay, 2);
+        GridMap<2> map_parallel(shape, size);
+        map_parallel.set_decay(decay, 2);
+
+        for (int k = 0; k < 4; ++k) {
+            std::vector<std::array<double, 2>> start_k(
+                start.begin() + k * rays / 4, 
+                start.begin() + (k + 1) * rays / 4);
+            std::vector<std::array<double, 2>> end_k(
+                end.begin() + k * rays / 4, 
+                end.begin() + (k + 1) * rays / 4);
+
+            for (int i = 0; i < (int)start_k.size(); ++i) {
+                trace_ray<2>(start_k[i], end_k[i], map_sequential);
+            }
+            trace_rays<2>(start_k, end_k, map_parallel);
+
+            map_sequential.age(k + 1);
+            map_parallel.age(k + 1);
+            REQUIRE(map_sequential == map_parallel);
+        }
+    }
+}
+
+
+TEST_CASE("pooling of hits and misses (2D)", "[2D]") {
+    std::array<int, 2> shape = {5, 3};
+    std::array<double, 2> size = {0.5, 1.0};
+
+    GridMap<2> map(shape, size);
+    for (int i = 0; i < 5; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            map.get_hit({i, j}) = i * 3 + j;
+            map.get_miss({i, j}) = 1;
+        }
+    }
+
+    GridMap<2> map_gt({3, 2}, {1.0, 2.0});
+    map_gt.set_hits(
+        {0 + 1 + 3 + 4, 2 + 5, 6 + 7 + 9 + 10, 8 + 11, 12 + 13, 14});
+    map_gt.set_misses({4, 2, 4, 2, 2, 1});
+
+    REQUIRE(map_gt == pool<2>(map, 2));
+    REQUIRE(map == pool<2>(map, 1));
+}
+
+
+template<int N>
+void random_test_pyramid(int factor) {
+    std::default_random_engine gen;
+    int const rays = 1000;
+    std::vector<std::array<double, N>> start;
+    std::vector<std::array<double, N>> end;
+    random_rays<N>(gen, rays, start, end);
+
+    std::array<int, N> shape;
+    std::array<double, N> size;
+    random_grid<N>(gen, shape, size);
+
+    GridMap<N> map(shape, size);
+    trace_rays<N>(start, end, map);
+
+    GridMapPyramid<N> pyramid(shape, size, 3, factor);
+    for (int k = 0; k < 4; ++k) {
+        pyramid.trace(
+            std::vector<std::array<double, N>>(
+                start.begin() + k * rays / 4,
+                start.begin() + (k + 1) * rays / 4),
+            std::vector<std::array<double, N>>(
+                end.begin() + k * rays / 4,
+                end.begin() + (k + 1) * rays / 4));
+    }
+
+    REQUIRE(pyramid.get_levels() == 3);
+    REQUIRE(pyramid.get_level(0) == map);
+    REQUIRE(pyramid.get_level(1) == pool<N>(map, factor));
+    REQUIRE(pyramid.get_level(2) == pool<N>(map, factor * factor));
+}
+
+
+TEST_CASE("incremental map pyramid (2D)", "[2D]") {
+    random_test_pyramid<2>(4);
+}
+
+
+TEST_CASE("incremental map pyramid (3D)", "[3D]") {
+    random_test_pyramid<3>(4);
+}
+
+
+TEST_CASE("incremental map pyramid with odd factor (2D)", "[2D]") {
+    random_test_pyramid<2>(3);
+}
+
+
+TEST_CASE("cell sizes of map pyramid with odd factor (2D)", "[2D]") {
+    std::array<int, 2> shape = {30, 30};
+    std::array<double, 2> size = {0.1, 0.1};
+
+    GridMap<2> map(shape, size);
+    trace_ray<2>({0.05, 0.05}, {2.95, 1.45}, map);
+
+    GridMapPyramid<2> pyramid(shape, size, 3, 3);
+    pyramid.add(map);
+    REQUIRE(pyramid.get_level(1) == pool<2>(map, 3));
+    REQUIRE(pyramid.get_level(2) == pool<2>(map, 9));
+}
+
+
+TEST_CASE("range image ray tracing with known cells (3D)", "[3D]") {
+    double const pi = std::acos(-1.0);
+    std::vector<double> const elevation = {0.0, pi / 2.0};
+    std::vector<double> const azimuth = {0.0, pi / 2.0};
+    std::vector<double> const ranges = {2.0, 100.0, 1.0, 0.0};
+    std::array<double, 3> const position = {3.5, 3.5, 3.5};
+    std::array<std::array<double, 3>, 3> const rotation = {{
+        {0.0, -1.0, 0.0},
+        {1.0, 0.0, 0.0},
+        {0.0, 0.0, 1.0}}};
+    std::array<int, 3> shape = {7, 7, 7};
+    std::array<double, 3> size = {1.0, 1.0, 1.0};
+
+    // The sensor is yawed by 90 degrees: its x axis points along y and its
+    // y axis along -x. The beam at azimuth 90 degrees exceeds the maximum 
+    // range and only clears space; the last beam has no return.
+    GridMap<3> map_gt(shape, size);
+    map_gt.get_miss({3, 3, 3}) = 3;
+    map_gt.get_miss({3, 4, 3}) = 1;
+    map_gt.get_hit({3, 5, 3}) = 1;
+    map_gt.get_miss({2, 3, 3}) = 1;
+    map_gt.get_miss({1, 3, 3}) = 1;
+    map_gt.get_miss({0, 3, 3}) = 1;
+    map_gt.get_hit({3, 3, 4}) = 1;
+
+    GridMap<3> map(shape, size);
+    trace_range_image(
+        ranges, elevation, azimuth, position, rotation, 3.0, map);
+
+    REQUIRE(map_gt == map);
+}
+
+
+TEST_CASE("range image ray tracing (3D)", "[3D]") {
+    std::default_random_engine gen;
+    std::uniform_real_distribution<double> range_dist(-5.0, 60.0);
+    double const pi = std::acos(-1.0);
+
+    int const rows = 16;
+    int const columns = 360;
+    std::vector<double> elevation(rows);
+    for (int r = 0; r < rows; ++r) {
+        elevation[r] = (-15.0 + 2.0 * r) * pi / 180.0;
+    }
+    std::vector<double> azimuth(columns);
+    for (int c = 0; c < columns; ++c) {
+        azimuth[c] = c * pi / 180.0;
+    }
+    std::vector<double> ranges(rows * columns);
+    for (int i = 0; i < rows * columns; ++i) {
+        ranges[i] = range_dist(gen);
+    }
+    ranges[7] = std::nan("");
+
+    std::array<double, 3> const position = {40.3, 38.7, 5.1};
+    double const yaw = 0.3;
+    std::array<std::array<double, 3>, 3> const rotation = {{
+        {std::cos(yaw), -std::sin(yaw), 0.0},
+        {std::sin(yaw), std::cos(yaw), 0.0},
+        {0.0, 0.0, 1.0}}};
+    double const max_range = 50.0;
+
+    std::array<int, 3> shape = {80, 80, 20};
+    std::array<double, 3> size = {1.0, 1.0, 0.5};
+
+    GridMap<3> map_gt(shape, size);
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c) {
+            double range = ranges[r * columns + c];
+            if (!(range > 0.0)) {
+                continue;
+            }
+
+            std::array<double, 3> const direction = {
+                std::cos(elevation[r]) * std::cos(azimuth[c]),
+                std::cos(elevation[r]) * std::sin(azimuth[c]),
+                std::sin(elevation[r])};
+            std::array<double, 3> end;
+            for (int i = 0; i < 3; ++i) {
+                end[i] = position[i] + std::min(range, max_range) * (
+                    rotation[i][0] * direction[0] 
+                    + rotation[i][1] * direction[1] 
+                    + rotation[i][2] * direction[2]);
+            }
+
+            if (range < max_range) {
+                trace_ray<3>(position, end, map_gt);
+            } else {
+                trace_ray<3>(position, end, map_gt, ClearPolicy<3>());
+            }
+        }
+    }
+
+    GridMap<3> map(shape, size);
+    trace_range_image(
+        ranges, elevation, azimuth, position, rotation, max_range, map);
+
+    REQUIRE(map_gt == map);
+}
+
+
+template <int N>
+struct WeightedPolicy {
+    void traverse(GridMap<N> & map, std::array<int, N> const & index) const {
+        map.get_miss(index) += 2;
+    }
+
+    void reflect(GridMap<N> & map, std::array<int, N> const & index) const {
+        map.get_hit(index) += 3;
+    }
+};
+
+
+template<int N>
+void random_test_policy() {
+    std::default_random_engine gen;
+    int const rays = 1000;
+    std::vector<std::array<double, N>> start;
+    std::vector<std::array<double, N>> end;
+    random_rays<N>(gen, rays, start, end);
+
+    std::array<int, N> shape;
+    std::array<double, N> size;
+    random_grid<N>(gen, shape, size);
+
+    GridMap<N> map(shape, size);
+    trace_rays<N>(start, end, map);
+    std::vector<int> hits = map.get_hits();
+    std::vector<int> misses = map.get_misses();
+
+    std::vector<int> weighted_hits(hits.size());
+    std::vector<int> weighted_misses(hits.size());
+    std::vector<int> clear_misses(hits.size());
+    for (int i = 0; i < (int)hits.size(); ++i) {
+        weighted_hits[i] = 3 * hits[i];
+        weighted_misses[i] = 2 * misses[i];
+        clear_misses[i] = hits[i] + misses[i];
+    }
+
+    GridMap<N> map_weighted(shape, size);
+    trace_rays<N>(start, end, map_weighted, WeightedPolicy<N>());
+    REQUIRE(map.set_hits(weighted_hits).set_misses(weighted_misses) 
+        == map_weighted);
+
+    GridMap<N> map_clear(shape, size);
+    trace_rays<N>(start, end, map_clear, ClearPolicy<N>());
+    REQUIRE(map.set_hits(std::vector<int>(hits.size(), 0))
+        .set_misses(clear_misses) == map_clear);
+}
+
+
+TEST_CASE("custom update policies (2D)", "[2D]") {
+    random_test_policy<2>();
+}
+
+
+TEST_CASE("custom update policies (3D)", "[3D]") {
+    random_test_policy<3>();
+}
+
+
+template<int N>
+void random_test_cells() {
+    std::default_random_engine gen;
+    int const rays = 1000;
+    std::vector<std::array<double, N>> start;
+    std::vector<std::array<double, N>> end;
+    random_rays<N>(gen, rays, start, end);
+
+    std::array<int, N> shape;
+    std::array<double, N> size;
+    random_grid<N>(gen, shape, size);
+
+    GridMap<N> map(shape, size);
+    std::vector<int> offsets;
+    std::vector<int> cells;
+    trace_cells<N>(start, end, map, offsets, cells);
+    REQUIRE((int)offsets.size() == rays + 1);
+    REQUIRE(offsets.back() == (int)cells.size());
+
+    for (int i = 0; i < rays; ++i) {
+        GridMap<N> map_ray(shape, size);
+        trace_ray<N>(start[i], end[i], map_ray);
+
+        std::vector<int> const hits = map_ray.get_hits();
+        std::vector<int> const misses = map_ray.get_misses();
+        std::vector<int> counts(hits.size(), 0);
+        std::vector<int> counts_gt(counts.size(), 0);
+        for (int j = offsets[i]; j < offsets[i + 1]; ++j) {
+            counts[cells[j]]++;
+        }
+        for (int j = 0; j < (int)counts.size(); ++j) {
+            counts_gt[j] = hits[j] + misses[j];
+        }
+        REQUIRE(counts_gt == counts);
+    }
+}
+
+
+TEST_CASE("traversed cells per ray (2D)", "[2D]") {
+    random_test_cells<2>();
+}
+
+
+TEST_CASE("traversed cells per ray (3D)", "[3D]") {
+    random_test_cells<3>();
+}
+
+
+TEST_CASE("traversed cells of empty batch (2D)", "[2D]") {
+    std::vector<std::array<double, 2>> start;
+    std::vector<std::array<double, 2>> end;
+    std::vector<int> offsets(3, 1);
+    std::vector<int> cells(5, 1);
+    trace_cells<2>(start, end, Grid<2>({{2, 2}}, {{1.0, 1.0}}), 
+        offsets, cells);
+    REQUIRE(offsets == std::vector<int>(1, 0));
+    REQUIRE(cells.empty());
+}
+
+
+template<int N>
+void random_test_traversal_cache() {
+    std::default_random_engine gen;
+    std::uniform_real_distribution<double> origin_dist(-10.0, 60.0);
+    std::uniform_real_distribution<double> direction_dist(-1.0, 1.0);
+    std::uniform_int_distribution<int> range_dist(-10, 110);
+
+    int const beams = 500;
+    int const bins = 100;
+    double const bin_width = 0.75;
+    std::array<double, N> origin;
+    for (int d = 0; d < N; ++d) {
+        origin[d] = origin_dist(gen);
+    }
+    std::vector<std::array<double, N>> directions(beams);
+    for (int i = 0; i < beams; ++i) {
+        for (int d = 0; d < N; ++d) {
+            directions[i][d] = direction_dist(gen);
+        }
+    }
+
+    std::array<int, N> shape;
+    std::array<double, N> size;
+    random_grid<N>(gen, shape, size);
+
+    GridMap<N> map(shape, size);
+    TraversalCache<N> cache(origin, directions, bin_width, bins, map);
+    REQUIRE(cache.get_memory() > beams * sizeof(int));
+
+    for (int frame = 0; frame < 3; ++frame) {
+        if (frame == 2) {
+            size[0] *= 0.5;
+            shape[0] *= 2;
+            map = GridMap<N>(shape, size);
+        }
+
+        std::vector<int> ranges(beams);
+        GridMap<N> map_gt(shape, size);
+        for (int i = 0; i < beams; ++i) {
+            ranges[i] = range_dist(gen);
+            if (ranges[i] < 0) {
+                continue;
+            }
+
+            double const length = norm<N>(directions[i]);
+            double const range = std::min(ranges[i] + 0.5, (double)bins)
+                * bin_width;
+            std::array<double, N> end;
+            for (int d = 0; d < N; ++d) {
+                end[d] = origin[d] + range * (directions[i][d] / length);
+            }
+
+            if (ranges[i] < bins) {
+                trace_ray<N>(origin, end, map_gt);
+            } else {
+                trace_ray<N>(origin, end, map_gt, ClearPolicy<N>());
+            }
+        }
+
+        if (frame == 1) {
+            map_gt += map;
+        }
+        cache.apply(ranges, map);
+        REQUIRE(map_gt == map);
+    }
+}
+
+
+TEST_CASE("traversal cache for static sensor (2D)", "[2D]") {
+    random_test_traversal_cache<2>();
+}
+
+
+TEST_CASE("traversal cache for static sensor (3D)", "[3D]") {
+    random_test_traversal_cache<3>();
+}
+
+
+TEST_CASE("traversal cache for grid-aligned sensor (2D)", "[2D]") {
+    double const pi = std::acos(-1.0);
+    int const beams = 24;
+    int const bins = 30;
+    double const bin_width = 1.0;
+    std::vector<std::array<double, 2>> directions(beams);
+    for (int i = 0; i < beams; ++i) {
+        directions[i][0] = std::cos(i * pi / 12.0);
+        directions[i][1] = std::sin(i * pi / 12.0);
+    }
+    directions[0] = {1.0, 0.0};
+    directions[3] = {1.0, 1.0};
+    directions[6] = {0.0, 1.0};
+    directions[9] = {-1.0, 1.0};
+    directions[12] = {-1.0, 0.0};
+    directions[15] = {-1.0, -1.0};
+    directions[18] = {0.0, -1.0};
+    directions[21] = {1.0, -1.0};
+
+    std::array<int, 2> shape = {20, 20};
+    std::array<double, 2> size = {1.0, 1.0};
+    std::vector<std::array<double, 2>> const origins = {
+        {0.0, 5.0}, {10.0, 10.0}, {3.0, 0.0}};
+    for (std::array<double, 2> const & origin : origins) {
+        GridMap<2> map(shape, size);
+        TraversalCache<2> cache(origin, directions, bin_width, bins, map);
+
+        double const range = bins * bin_width;
+        std::vector<std::array<double, 2>> start(beams, origin);
+        std::vector<std::array<double, 2>> end(beams);
+        std::vector<std::array<double, 2>> unit(beams);
+        for (int i = 0; i < beams; ++i) {
+            double const length = norm<2>(directions[i]);
+            for (int d = 0; d < 2; ++d) {
+                unit[i][d] = directions[i][d] / length;
+                end[i][d] = origin[d] + range * unit[i][d];
+            }
+        }
+        std::vector<int> offsets;
+        std::vector<int> cells;
+        trace_cells<2>(start, end, Grid<2>(shape, size), offsets, cells);
+
+        for (int b = -1; b <= bins; ++b) {
+            GridMap<2> map_gt(shape, size);
+            for (int i = 0; i < beams && b >= 0; ++i) {
+                int endpoint = -1;
+                std::array<int, 2> index;
+                for (int d = 0; d < 2; ++d) {
+                    index[d] = std::floor(
+                        (origin[d] + (b + 0.5) * bin_width * unit[i][d]) 
+                            / size[d]);
+                }
+                if (b < bins && index[0] >= 0 && index[0] < shape[0]
+                        && index[1] >= 0 && index[1] < shape[1]) {
+                    endpoint = map_gt.linear_index(index);
+                }
+
+                for (int k = offsets[i]; k < offsets[i + 1]; ++k) {
+                    if (cells[k] == endpoint) {
+                        map_gt.get_hit(cells[k])++;
+                        break;
+                    }
+                    map_gt.get_miss(cells[k])++;
+                }
+            }
+
+            GridMap<2> map_cache(shape, size);
+            cache.apply(std::vector<int>(beams, b), map_cache);
+            REQUIRE(map_gt == map_cache);
+        }
+    }
+}
+
+
+TEST_CASE("traversal cache without beams (2D)", "[2D]") {
+    GridMap<2> map({{4, 4}}, {{1.0, 1.0}});
+    TraversalCache<2> cache({{2.0, 2.0}}, 
+        std::vector<std::array<double, 2>>(), 1.0, 10, map);
+    REQUIRE(cache.get_beams() == 0);
+
+    cache.apply(std::vector<int>(), map);
+    REQUIRE(map == GridMap<2>({{4, 4}}, {{1.0, 1.0}}));
+}
+
+
+TEST_CASE("truncated band around endpoint (1D)", "[1D]") {
+    std::array<double, 1> start = {0.051};
+    std::array<double, 1> end = {0.985};
+    std::array<int, 1> shape = {100};
+    std::array<double, 1> size = {0.01};
+
+    GridMap<1> map_gt(shape, size);
+    int i;
+    for (i = 88; i < 98; ++i) {
+        map_gt.get_miss({i})++;
+    }
+    map_gt.get_hit({i})++;
+
+    GridMap<1> map(shape, size);
+    trace_ray_band<1>(start, end, map, 0.1);
+    REQUIRE(map_gt == map);
+
+    map_gt.get_hit({99})++;
+    GridMap<1> free_map_gt({10}, {0.1});
+    for (i = 0; i < 9; ++i) {
+        free_map_gt.get_miss({i})++;
+    }
+
+    map = GridMap<1>(shape, size);
+    GridMap<1> free_map({10}, {0.1});
+    trace_ray_band<1>(start, end, map, 0.1, 0.05, &free_map);
+    REQUIRE(map_gt == map);
+    REQUIRE(free_map_gt == free_map);
+
+    map = GridMap<1>(shape, size);
+    trace_ray_band<1>(start, end, map, 10.0);
+    map_gt = GridMap<1>(shape, size);
+    trace_ray<1>(start, end, map_gt);
+    REQUIRE(map_gt == map);
+}
+
+
+TEST_CASE("truncated band with endpoint on cell face (1D)", "[1D]") {
+    std::array<int, 1> shape = {5};
+    std::array<double, 1> size = {1.0};
+
+    GridMap<1> map_gt(shape, size);
+    map_gt.get_miss({0})++;
+    map_gt.get_hit({1})++;
+    map_gt.get_hit({2})++;
+
+    GridMap<1> map(shape, size);
+    trace_ray_band<1>({0.5}, {2.0}, map, 10.0, 1.0);
+    REQUIRE(map_gt == map);
+}
+
+
+TEST_CASE("truncated band with negative width (1D)", "[1D]") {
+    GridMap<1> map({5}, {1.0});
+    REQUIRE_THROWS_AS(trace_ray_band<1>({0.5}, {2.5}, map, -1.0), 
+        std::invalid_argument);
+    REQUIRE_THROWS_AS(trace_ray_band<1>({0.5}, {2.5}, map, 1.0, -1.0), 
+        std::invalid_argument);
+}
+
+
+template<int N>
+void random_test_band() {
+    std::default_random_engine gen;
+    int const rays = 1000;
+    std::vector<std::array<double, N>> start;
+    std::vector<std::array<double, N>> end;
+    random_rays<N>(gen, rays, start, end);
+
+    std::array<int, N> shape;
+    std::array<double, N> size;
+    random_grid<N>(gen, shape, size);
+    GridMap<N> const free_map_template = pool<N>(GridMap<N>(shape, size), 4);
+
+    GridMap<N> map_sequential(shape, size);
+    GridMap<N> free_map_sequential(free_map_template);
+    for (int i = 0; i < rays; ++i) {
+        trace_ray_band<N>(start[i], end[i], map_sequential, 15.0, 5.0, 
+            &free_map_sequential);
+    }
+
+    GridMap<N> map_parallel(shape, size);
+    GridMap<N> free_map_parallel(free_map_template);
+    trace_rays_band<N>(start, end, map_parallel, 15.0, 5.0, 
+        &free_map_parallel);
+
+    REQUIRE(map_sequential == map_parallel);
+    REQUIRE(free_map_sequential == free_map_parallel);
+
+    GridMap<N> map_full(shape, size);
+    trace_rays<N>(start, end, map_full);
+    GridMap<N> map_band(shape, size);
+    trace_rays_band<N>(start, end, map_band, 1000.0);
+    REQUIRE(map_full == map_band);
+}
+
+
+TEST_CASE("random truncated band ray tracing (2D)", "[2D]") {
+    random_test_band<2>();
+}
+
+
+TEST_CASE("random truncated band ray tracing (3D)", "[3D]") {
+    random_test_band<3>();
+}
@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <random>
+#include <vector>
 
 
 template <int N>
@@ -17,6 +19,38 @@ static double norm(std::array<double, N> const & a) {
 }
 
 
+template <int N>
+void random_rays(
+        std::default_random_engine & gen,
+        int rays,
+        std::vector<std::array<double, N>> & start,
+        std::vector<std::array<double, N>> & end) {
+    std::uniform_real_distribution<double> point_dist(-10.0, 110.0);
+    start.resize(rays);
+    end.resize(rays);
+    for (int i = 0; i < rays; ++i) {
+        for (int d = 0; d < N; ++d) {
+            start[i][d] = point_dist(gen);
+            end[i][d] = point_dist(gen);
+        }
+    }
+}
+
+
+template <int N>
+void random_grid(
+        std::default_random_engine & gen,
+        std::array<int, N> & shape,
+        std::array<double, N> & size) {
+    std::uniform_real_distribution<double> extent_dist(1.0, 100.0);
+    std::uniform_real_distribution<double> size_dist(1.0, 10.0);
+    for (int d = 0; d < N; ++d) {
+        size[d] = size_dist(gen);
+        shape[d] = std::max(1, (int)(extent_dist(gen) / size[d]));
+    }
+}
+
+
 template <int N>
 void trace_ray_num(
         std::array<double, N> const & start, 
@@ -0,0 +1,207 @@
+#ifndef TRAVERSAL_CACHE_H_
+#define TRAVERSAL_CACHE_H_ TRAVERSAL_CACHE_H_
+
+#include "grid_map.hpp"
+#include "ray_tracing.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <exception>
+#include <sstream>
+#include <vector>
+
+
+// Precomputed traversals of the beams of a static sensor. Beam i starts at
+// "origin" and points along "directions[i]"; a return in range bin b ends
+// at distance (b + 0.5) * bin_width. Each frame is then applied by replaying
+// the cached cells of every beam up to the cell of its range bin.
+//
+// The cells of a beam are those of a single traversal of the full beam,
+// truncated at the cell that contains the endpoint of the bin. Where a beam
+// passes exactly through a cell corner, trace_ray may resolve the tie
+// differently for a shorter ray, so the result can then differ from 
+// tracing each return individually.
+template <int N>
+class TraversalCache {
+private:
+    std::array<double, N> origin;
+    std::vector<std::array<double, N>> directions;
+    double bin_width;
+    int bins;
+    std::array<int, N> shape;
+    std::array<double, N> size;
+    std::vector<int> offsets;
+    std::vector<int> cells;
+    std::vector<int> first_bins;
+    std::vector<int> exit_bins;
+
+public:
+    TraversalCache(
+                std::array<double, N> const & origin,
+                std::vector<std::array<double, N>> const & directions,
+                double bin_width,
+                int bins,
+                GridMap<N> const & map)
+            : origin(origin), directions(directions), bin_width(bin_width),
+              bins(bins) {
+        if (!(bin_width > 0.0) || bins < 1) {
+            throw std::invalid_argument(
+                "Input arguments \"bin_width\" and \"bins\" must be "
+                "positive.");
+        }
+
+        for (int i = 0; i < (int)this->directions.size(); ++i) {
+            double const length = norm(this->directions[i]);
+            if (!(length > 0.0)) {
+                throw std::invalid_argument(
+                    "Input argument \"directions\" must not contain zero "
+                    "vectors.");
+            }
+            for (int d = 0; d < N; ++d) {
+                this->directions[i][d] /= length;
+            }
+        }
+
+        this->build(map);
+    }
+
+protected:
+    static double norm(std::array<double, N> const & a) {
+        double sqsum = 0.0;
+        for (int i = 0; i < N; ++i) {
+            sqsum += a[i] * a[i];
+        }
+        return std::sqrt(sqsum);
+    }
+
+    // Converts a ray parameter t in [0, 1] along the full beam into the
+    // first range bin whose endpoint lies beyond t.
+    int bin(double t) const {
+        return std::max(0, (int)std::floor(t * this->bins - 0.5) + 1);
+    }
+
+    void build(GridMap<N> const & map) {
+        this->shape = map.get_shape();
+        this->size = map.get_size();
+
+        int const beams = this->directions.size();
+        double const range = this->bins * this->bin_width;
+        std::vector<std::array<double, N>> start(beams, this->origin);
+        std::vector<std::array<double, N>> end(beams);
+        for (int i = 0; i < beams; ++i) {
+            for (int d = 0; d < N; ++d) {
+                end[i][d] = this->origin[d] + range * this->directions[i][d];
+            }
+        }
+        trace_cells<N>(start, end, map, this->offsets, this->cells);
+        this->cells.shrink_to_fit();
+
+        this->first_bins.resize(this->cells.size());
+        this->exit_bins.assign(beams, this->bins);
+        std::array<int, N> index;
+        for (int i = 0; i < beams; ++i) {
+            std::array<double, N> v;
+            for (int d = 0; d < N; ++d) {
+                v[d] = end[i][d] - this->origin[d];
+            }
+
+            double t_exit = 1.0;
+            for (int k = this->offsets[i]; k < this->offsets[i + 1]; ++k) {
+                int rest = this->cells[k];
+                for (int d = N - 1; d >= 0; --d) {
+                    index[d] = rest % this->shape[d];
+                    rest /= this->shape[d];
+                }
+
+                double t_entry = 0.0;
+                t_exit = 1.0;
+                for (int d = 0; d < N; ++d) {
+                    int const face = index[d] + (v[d] < 0.0);
+                    t_entry = std::max(t_entry,
+                        (face * this->size[d] - this->origin[d]) / v[d]);
+                    t_exit = std::min(t_exit,
+                        ((index[d] + (v[d] >= 0.0)) * this->size[d]
+                            - this->origin[d]) / v[d]);
+                }
+                this->first_bins[k] = this->bin(t_entry);
+            }
+
+            if (t_exit < 1.0) {
+                this->exit_bins[i] = this->bin(t_exit);
+            }
+        }
+    }
+
+    void replay(int beam, int range, GridMap<N> & map) const {
+        if (range < 0) {
+            return;
+        }
+
+        std::vector<int>::const_iterator const first =
+            this->first_bins.begin() + this->offsets[beam];
+        std::vector<int>::const_iterator last =
+            this->first_bins.begin() + this->offsets[beam + 1];
+        if (range < this->bins) {
+            last = std::upper_bound(first, last, range);
+        }
+
+        int const * cell = this->cells.data() + this->offsets[beam];
+        int const * const cells_end = cell + (last - first);
+        if (range < this->exit_bins[beam] && cell != cells_end) {
+            map.get_hit(*(cells_end - 1))++;
+            for (; cell != cells_end - 1; ++cell) {
+                map.get_miss(*cell)++;
+            }
+        } else {
+            for (; cell != cells_end; ++cell) {
+                map.get_miss(*cell)++;
+            }
+        }
+    }
+
+public:
+    // Applies one frame given the range bin of each beam. Negative bins mark
+    // beams without return; bins at or beyond "bins" only clear space. The
+    // cache is rebuilt if the geometry of the map has changed.
+    void apply(std::vector<int> const & ranges, GridMap<N> & map) {
+        if (ranges.size() != this->directions.size()) {
+            std::stringstream msg;
+            msg << "Input argument \"ranges\" must have "
+                << this->directions.size() << " elements.";
+            throw std::invalid_argument(msg.str());
+        }
+
+        if (map.get_shape() != this->shape || map.get_size() != this->size) {
+            this->build(map);
+        }
+
+        trace_parallel<N>(ranges.size(), map, nullptr,
+            [&](int i, GridMap<N> & worker_map, GridMap<N> *) {
+                this->replay(i, ranges[i], worker_map);
+            });
+    }
+
+    // Returns the number of bytes occupied by the cached traversals.
+    size_t get_memory() const {
+        return sizeof(*this)
+            + this->directions.capacity() * sizeof(std::array<double, N>)
+            + (this->offsets.capacity() + this->cells.capacity()
+                + this->first_bins.capacity() + this->exit_bins.capacity())
+                * sizeof(int);
+    }
+
+    int get_beams() const {
+        return this->directions.size();
+    }
+
+    int get_bins() const {
+        return this->bins;
+    }
+
+    double get_bin_width() const {
+        return this->bin_width;
+    }
+};
+
+
+#endif
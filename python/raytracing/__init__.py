@@ -1,2 +1,6 @@
 from gridmap import gridmap
-from raytracing import trace1d, trace2d, trace3d
+from gridmappyramid import gridmappyramid
+from traversalcache import traversalcache
+from raytracing import trace1d, trace2d, trace3d, trace_range_image
+from raytracing import trace_band1d, trace_band2d, trace_band3d
+from raytracing import trace_cells1d, trace_cells2d, trace_cells3d
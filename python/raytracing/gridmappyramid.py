@@ -0,0 +1,35 @@
+#!/usr/bin/env python
+
+from gridmap import gridmap
+import numpy as np
+import ray_tracing_python as rtp
+
+
+class gridmappyramid(object):
+    def __init__(self, shape, size, levels, factor=2):
+        if len(shape) not in (1, 2, 3):
+            raise ValueError('Only 1D, 2D, and 3D pyramids are supported.')
+        self.dim = len(shape)
+        self.pyramid = getattr(rtp, 'gridmappyramid{}'.format(self.dim))(
+            shape, size, levels, factor)
+
+    def trace(self, start, end):
+        vad = getattr(rtp, 'vad{}'.format(self.dim))
+        self.pyramid.trace(vad(start), vad(end))
+
+    def level(self, level):
+        level_map = self.pyramid.level(level)
+        map = gridmap(np.array(level_map.shape), np.array(level_map.size))
+        map.hits = np.array(
+            level_map.hits, dtype=np.int, copy=False).reshape(map.shape)
+        map.misses = np.array(
+            level_map.misses, dtype=np.int, copy=False).reshape(map.shape)
+        return map
+
+    @property
+    def levels(self):
+        return self.pyramid.levels
+
+    @property
+    def factor(self):
+        return self.pyramid.factor
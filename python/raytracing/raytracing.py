@@ -25,4 +25,74 @@ def trace3d(start, end, map):
     map.hits += np.array(map3.hits, dtype=np.int, copy=False).reshape(map.shape)
     map.misses += np.array(map3.misses, dtype=np.int, copy=False).reshape(
         map.shape)
-    
\ No newline at end of file
+
+
+def trace_band1d(start, end, map, before, behind=0.0, free_map=None):
+    map1 = rtp.gridmap1(map.shape, map.size)
+    free_map1 = None if free_map is None \
+        else rtp.gridmap1(free_map.shape, free_map.size)
+    rtp.trace_band1d(
+        rtp.vad1(start), rtp.vad1(end), map1, before, behind, free_map1)
+    map.hits += np.array(map1.hits, dtype=np.int, copy=False)
+    map.misses += np.array(map1.misses, dtype=np.int, copy=False)
+    if free_map is not None:
+        free_map.misses += np.array(free_map1.misses, dtype=np.int, copy=False)
+
+
+def trace_band2d(start, end, map, before, behind=0.0, free_map=None):
+    map2 = rtp.gridmap2(map.shape, map.size)
+    free_map2 = None if free_map is None \
+        else rtp.gridmap2(free_map.shape, free_map.size)
+    rtp.trace_band2d(
+        rtp.vad2(start), rtp.vad2(end), map2, before, behind, free_map2)
+    map.hits += np.array(map2.hits, dtype=np.int, copy=False).reshape(map.shape)
+    map.misses += np.array(map2.misses, dtype=np.int, copy=False).reshape(
+        map.shape)
+    if free_map is not None:
+        free_map.misses += np.array(
+            free_map2.misses, dtype=np.int, copy=False).reshape(free_map.shape)
+
+
+def trace_band3d(start, end, map, before, behind=0.0, free_map=None):
+    map3 = rtp.gridmap3(map.shape, map.size)
+    free_map3 = None if free_map is None \
+        else rtp.gridmap3(free_map.shape, free_map.size)
+    rtp.trace_band3d(
+        rtp.vad3(start), rtp.vad3(end), map3, before, behind, free_map3)
+    map.hits += np.array(map3.hits, dtype=np.int, copy=False).reshape(map.shape)
+    map.misses += np.array(map3.misses, dtype=np.int, copy=False).reshape(
+        map.shape)
+    if free_map is not None:
+        free_map.misses += np.array(
+            free_map3.misses, dtype=np.int, copy=False).reshape(free_map.shape)
+
+
+def trace_cells1d(start, end, map):
+    offsets, cells = rtp.trace_cells1d(rtp.vad1(start), rtp.vad1(end), 
+        map.shape, map.size)
+    return np.array(offsets, copy=False), np.array(cells, copy=False)
+
+
+def trace_cells2d(start, end, map):
+    offsets, cells = rtp.trace_cells2d(rtp.vad2(start), rtp.vad2(end), 
+        map.shape, map.size)
+    return np.array(offsets, copy=False), np.array(cells, copy=False)
+
+
+def trace_cells3d(start, end, map):
+    offsets, cells = rtp.trace_cells3d(rtp.vad3(start), rtp.vad3(end), 
+        map.shape, map.size)
+    return np.array(offsets, copy=False), np.array(cells, copy=False)
+
+
+def trace_range_image(ranges, elevation, azimuth, position, rotation, 
+        max_range, map):
+    map3 = rtp.gridmap3(map.shape, map.size)
+    rtp.trace_range_image(
+        rtp.vd(np.ravel(np.asarray(ranges, dtype=np.float64))), 
+        rtp.vd(np.asarray(elevation, dtype=np.float64)), 
+        rtp.vd(np.asarray(azimuth, dtype=np.float64)), 
+        position, rotation, max_range, map3)
+    map.hits += np.array(map3.hits, dtype=np.int, copy=False).reshape(map.shape)
+    map.misses += np.array(map3.misses, dtype=np.int, copy=False).reshape(
+        map.shape)
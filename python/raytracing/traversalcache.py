@@ -0,0 +1,42 @@
+#!/usr/bin/env python
+
+import numpy as np
+import ray_tracing_python as rtp
+
+
+class traversalcache(object):
+    def __init__(self, origin, directions, bin_width, bins, map):
+        if len(origin) not in (1, 2, 3):
+            raise ValueError('Only 1D, 2D, and 3D caches are supported.')
+        self.dim = len(origin)
+        self.cache = getattr(rtp, 'traversalcache{}'.format(self.dim))(
+            origin, getattr(rtp, 'vad{}'.format(self.dim))(directions), 
+            bin_width, bins, self.rtp_map(map))
+
+    def rtp_map(self, map):
+        return getattr(rtp, 'gridmap{}'.format(self.dim))(map.shape, map.size)
+
+    def apply(self, ranges, map):
+        map_rtp = self.rtp_map(map)
+        self.cache.apply(
+            rtp.vi(np.asarray(ranges, dtype=np.intc)), map_rtp)
+        map.hits += np.array(
+            map_rtp.hits, dtype=np.int, copy=False).reshape(map.shape)
+        map.misses += np.array(
+            map_rtp.misses, dtype=np.int, copy=False).reshape(map.shape)
+
+    @property
+    def memory(self):
+        return self.cache.memory
+
+    @property
+    def beams(self):
+        return self.cache.beams
+
+    @property
+    def bins(self):
+        return self.cache.bins
+
+    @property
+    def bin_width(self):
+        return self.cache.bin_width
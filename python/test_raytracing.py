@@ -176,5 +176,130 @@ def test_parallel_ray_tracing_2d():
 
     assert(map_gt == map)
 
+
+def pool_2d(map, factor):
+    shape = -(-map.shape // factor)
+    pooled = rt.gridmap(shape, map.size * factor)
+    pad = [(0, shape[i] * factor - map.shape[i]) for i in range(2)]
+    pooled.hits = np.pad(map.hits, pad, 'constant').reshape(
+        shape[0], factor, shape[1], factor).sum(axis=(1, 3))
+    pooled.misses = np.pad(map.misses, pad, 'constant').reshape(
+        shape[0], factor, shape[1], factor).sum(axis=(1, 3))
+    return pooled
+
+
+def test_map_pyramid_2d():
+    start = np.array(
+        [[-1.5, +1.5], 
+         [+1.0, -2.0], 
+         [+3.5, -1.0], 
+         [+7.5, +1.0], 
+         [+5.5, +4.5], 
+         [-0.5, +2.0]])
+    end = np.array(
+        [[+2.5, +1.5],
+         [+1.0, -0.5],
+         [+3.5, +1.5],
+         [+4.5, +0.5],
+         [+5.5, +2.5],
+         [+1.0, +3.5]])
+    shape = np.array([6, 3])
+    size = np.array([1.0, 1.0])
+
+    map = rt.gridmap(shape, size)
+    rt.trace2d(start, end, map)
+
+    pyramid = rt.gridmappyramid(shape, size, 3, 2)
+    pyramid.trace(start[:3], end[:3])
+    pyramid.trace(start[3:], end[3:])
+
+    assert(pyramid.levels == 3)
+    assert(pyramid.level(0) == map)
+    assert(pyramid.level(1) == pool_2d(map, 2))
+    assert(pyramid.level(2) == pool_2d(map, 4))
+
+
+def test_truncated_band_1d():
+    start = np.array([[0.051]])
+    end = np.array([[0.985]])
+    shape = np.array([100])
+    size = np.array([0.01])
+
+    map_gt = rt.gridmap(shape, size)
+    map_gt.misses[88:98] = 1
+    map_gt.hits[98:] = 1
+    free_map_gt = rt.gridmap(np.array([10]), np.array([0.1]))
+    free_map_gt.misses[:9] = 1
+
+    map = rt.gridmap(shape, size)
+    free_map = rt.gridmap(np.array([10]), np.array([0.1]))
+    rt.trace_band1d(start, end, map, 0.1, 0.05, free_map)
+
+    assert(map_gt == map)
+    assert(free_map_gt == free_map)
+
+
+def test_traversed_cells_2d():
+    start = np.array(
+        [[-1.5, +1.5], 
+         [+1.0, -2.0], 
+         [+0.5, +0.5]])
+    end = np.array(
+        [[+2.5, +1.5],
+         [+1.0, -0.5],
+         [+0.5, +0.5]])
+    shape = np.array([6, 3])
+    size = np.array([1, 1])
+
+    map = rt.gridmap(shape, size)
+    offsets, cells = rt.trace_cells2d(start, end, map)
+
+    assert(np.array_equal(offsets, [0, 3, 3, 4]))
+    assert(np.array_equal(cells, np.ravel_multi_index(
+        ([0, 1, 2, 0], [1, 1, 1, 0]), shape)))
+
+
+def test_range_image_ray_tracing_3d():
+    ranges = np.array([[2.2, 100.0, np.nan]])
+    elevation = np.array([0.0])
+    azimuth = np.array([0.0, np.pi / 2.0, np.pi])
+    position = np.array([0.5, 0.5, 0.5])
+    rotation = np.eye(3)
+    shape = np.array([5, 5, 1])
+    size = np.array([1.0, 1.0, 1.0])
+
+    map_gt = rt.gridmap(shape, size)
+    map_gt.misses[:2,0,0] += 1
+    map_gt.hits[2,0,0] += 1
+    map_gt.misses[0,:,0] += 1
+
+    map = rt.gridmap(shape, size)
+    rt.trace_range_image(
+        ranges, elevation, azimuth, position, rotation, 10.0, map)
+
+    assert(map_gt == map)
+
+
+def test_traversal_cache_2d():
+    origin = np.array([0.5, 0.5])
+    directions = np.array([[1.0, 0.0], [0.0, 1.0], [1.0, 0.5]])
+    shape = np.array([10, 10])
+    size = np.array([1.0, 1.0])
+
+    map = rt.gridmap(shape, size)
+    cache = rt.traversalcache(origin, directions, 0.7, 20, map)
+    assert(cache.beams == 3)
+    assert(cache.bins == 20)
+
+    cache.apply(np.array([3, -1, 25]), map)
+
+    direction = directions[2] / np.linalg.norm(directions[2])
+    map_gt = rt.gridmap(shape, size)
+    rt.trace2d(np.array([origin, origin]), 
+        np.array([origin + [2.45, 0.0], origin + 14.0 * direction]), map_gt)
+
+    assert(map_gt == map)
+
+
 if __name__ == '__main__':
     pytest.main()